@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#include "BenchmarkCompare.h"
+
+#include <ArduinoJson.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+double toNanoseconds(double time, const char *unit) {
+  std::string timeUnit = unit == nullptr ? "ns" : unit;
+  if (timeUnit == "us") return time * 1e3;
+  if (timeUnit == "ms") return time * 1e6;
+  if (timeUnit == "s") return time * 1e9;
+  return time;
+}
+
+struct Runs {
+  // CPU time per iteration in ns
+  std::map<std::string, double> times;
+  std::vector<std::string> order;
+  std::set<std::string> failed;
+};
+
+bool isAggregate(JsonObject benchmark) {
+  return benchmark["run_type"] == "aggregate";
+}
+
+/**
+ * Repetitions report every iteration run under the same name, so when a
+ * file has aggregates only those are compared. Only the mean and median
+ * describe a benchmark, the other aggregates (stddev, or the complexity
+ * fits) can't be compared as a time.
+ */
+bool isCompared(JsonObject benchmark, bool hasAggregates) {
+  if (!hasAggregates) return !isAggregate(benchmark);
+  if (!isAggregate(benchmark)) return false;
+  std::string aggregate = benchmark["aggregate_name"] | "";
+  return aggregate == "mean" || aggregate == "median";
+}
+
+bool parseRuns(const std::string &json, Runs *runs) {
+  size_t capacity = json.size() * 2;
+  std::unique_ptr<DynamicJsonDocument> doc(new DynamicJsonDocument(capacity));
+  auto error = deserializeJson(*doc, json);
+  while (error == DeserializationError::NoMemory) {
+    capacity *= 2;
+    doc.reset(new DynamicJsonDocument(capacity));
+    error = deserializeJson(*doc, json);
+  }
+  if (error) return false;
+  JsonArray benchmarks = (*doc)["benchmarks"];
+  if (benchmarks.isNull()) return false;
+  bool hasAggregates = false;
+  for (JsonObject benchmark : benchmarks)
+    hasAggregates |= isAggregate(benchmark);
+  for (JsonObject benchmark : benchmarks) {
+    const char *name = benchmark["name"];
+    if (name == nullptr) continue;
+    if (benchmark["error_occurred"] | false) {
+      runs->failed.insert(name);
+      continue;
+    }
+    if (!isCompared(benchmark, hasAggregates)) continue;
+    // A run without a positive time can't be compared against
+    if (!benchmark["cpu_time"].is<double>() ||
+        benchmark["cpu_time"].as<double>() <= 0) {
+      runs->failed.insert(name);
+      continue;
+    }
+    if (runs->times.find(name) == runs->times.end())
+      runs->order.push_back(name);
+    runs->times[name] =
+        toNanoseconds(benchmark["cpu_time"].as<double>(),
+                      benchmark["time_unit"].as<const char *>());
+  }
+  return true;
+}
+
+}  // namespace
+
+SHI::BenchmarkCompare::CompareErrors SHI::BenchmarkCompare::compare(
+    const std::string &baselineJson, const std::string &currentJson,
+    double threshold, bool allowMissing, std::vector<Result> *results,
+    std::vector<std::string> *missing, std::vector<std::string> *failed) {
+  Runs baseline;
+  if (!parseRuns(baselineJson, &baseline))
+    return CompareErrors::FailureToParseBaseline;
+  Runs current;
+  if (!parseRuns(currentJson, &current))
+    return CompareErrors::FailureToParseCurrent;
+
+  std::set<std::string> allFailed(baseline.failed);
+  allFailed.insert(current.failed.begin(), current.failed.end());
+  failed->insert(failed->end(), allFailed.begin(), allFailed.end());
+  bool regressed = false;
+  for (auto &&name : baseline.order) {
+    auto currentTime = current.times.find(name);
+    if (currentTime == current.times.end()) {
+      if (allFailed.find(name) == allFailed.end()) missing->push_back(name);
+      continue;
+    }
+    double baselineTime = baseline.times[name];
+    double change = currentTime->second / baselineTime - 1;
+    bool isRegression = change > threshold;
+    regressed |= isRegression;
+    results->push_back(
+        {name, baselineTime, currentTime->second, change, isRegression});
+  }
+  if (!failed->empty()) return CompareErrors::BenchmarkFailed;
+  if (!missing->empty() && !allowMissing)
+    return CompareErrors::MissingBenchmark;
+  return regressed ? CompareErrors::Regression : CompareErrors::None;
+}
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace SHI {
+
+/**
+ * Compares two Google Benchmark JSON outputs, as written with
+ * --benchmark_out=<file> --benchmark_out_format=json.
+ */
+namespace BenchmarkCompare {
+
+enum class CompareErrors {
+  None,
+  FailureToParseBaseline,
+  FailureToParseCurrent,
+  BenchmarkFailed,
+  MissingBenchmark,
+  Regression
+};
+
+struct Result {
+  std::string name;
+  // CPU time per iteration in ns
+  double baseline;
+  double current;
+  // Relative change, 0.1 means 10% slower than the baseline
+  double change;
+  bool regressed;
+};
+
+/**
+ * Compares the CPU time of every benchmark in baselineJson with the
+ * benchmark of the same name in currentJson. A benchmark regressed when it
+ * is more than threshold slower than its baseline.
+ *
+ * When a file contains aggregates, only its _mean and _median aggregates
+ * are compared, otherwise its iteration runs. Runs that reported an error
+ * or have no positive cpu_time are listed in failed. Benchmarks that are only in the
+ * baseline are listed in missing, they fail the comparison unless
+ * allowMissing is set. Failures take precedence over missing benchmarks,
+ * and both over regressions.
+ */
+CompareErrors compare(const std::string &baselineJson,
+                      const std::string &currentJson, double threshold,
+                      bool allowMissing, std::vector<Result> *results,
+                      std::vector<std::string> *missing,
+                      std::vector<std::string> *failed);
+
+}  // namespace BenchmarkCompare
+
+}  // namespace SHI
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BenchmarkCompare.h"
+
+namespace {
+
+bool loadFile(const char *fileName, std::string *content) {
+  std::ifstream inFile(fileName);
+  if (!inFile) return false;
+  std::stringstream strStream;
+  strStream << inFile.rdbuf();
+  *content = strStream.str();
+  return true;
+}
+
+/**
+ * Parses a threshold like 0.1, rejects anything that is not a complete,
+ * non-negative number.
+ */
+bool parseThreshold(const char *value, double *threshold) {
+  char *end = nullptr;
+  errno = 0;
+  double parsed = strtod(value, &end);
+  if (end == value || *end != '\0' || errno != 0 || !(parsed >= 0))
+    return false;
+  *threshold = parsed;
+  return true;
+}
+
+int usage(const char *name) {
+  std::cerr << "Usage: " << name
+            << " <baseline.json> <current.json> [--threshold=0.1]"
+               " [--allow-missing]\n"
+               "Both files are written by a benchmark binary with\n"
+               "--benchmark_out=<file> --benchmark_out_format=json. Fails "
+               "when a\nbenchmark is slower than the threshold allows, when "
+               "a benchmark\nreported an error, or when a benchmark of the "
+               "baseline is missing\nand --allow-missing is not given."
+            << std::endl;
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double threshold = 0.1;
+  bool allowMissing = false;
+  std::vector<const char *> files;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--allow-missing") == 0) {
+      allowMissing = true;
+    } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+      if (!parseThreshold(argv[i] + 12, &threshold)) {
+        std::cerr << "Invalid threshold: " << argv[i] + 12 << std::endl;
+        return usage(argv[0]);
+      }
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.size() != 2) return usage(argv[0]);
+  std::string baseline, current;
+  if (!loadFile(files[0], &baseline) || !loadFile(files[1], &current)) {
+    std::cerr << "Failed to read the benchmark results" << std::endl;
+    return 2;
+  }
+
+  std::vector<SHI::BenchmarkCompare::Result> results;
+  std::vector<std::string> missing;
+  std::vector<std::string> failed;
+  auto error = SHI::BenchmarkCompare::compare(
+      baseline, current, threshold, allowMissing, &results, &missing, &failed);
+  switch (error) {
+    case SHI::BenchmarkCompare::CompareErrors::FailureToParseBaseline:
+      std::cerr << "Failed to parse " << files[0] << std::endl;
+      return 2;
+    case SHI::BenchmarkCompare::CompareErrors::FailureToParseCurrent:
+      std::cerr << "Failed to parse " << files[1] << std::endl;
+      return 2;
+    default:
+      break;
+  }
+  for (auto &&result : results) {
+    printf("%-50s %12.1fns %12.1fns %+7.1f%%%s\n", result.name.c_str(),
+           result.baseline, result.current, result.change * 100,
+           result.regressed ? " REGRESSION" : "");
+  }
+  for (auto &&name : missing) printf("%-50s missing\n", name.c_str());
+  for (auto &&name : failed) printf("%-50s failed\n", name.c_str());
+  return error == SHI::BenchmarkCompare::CompareErrors::None ? 0 : 1;
+}
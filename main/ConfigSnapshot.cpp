@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#include "ConfigSnapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Private, writable mapping of a file. Writes are copy-on-write and never
+// reach the file, which lets the MessagePack decoder work in place.
+class FileMapping {
+ public:
+  explicit FileMapping(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+      opened = true;
+      if (info.st_size > 0) {
+        void *mapped = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+          data = static_cast<uint8_t *>(mapped);
+          size = info.st_size;
+        }
+      }
+    }
+    close(fd);
+  }
+  ~FileMapping() {
+    if (data != nullptr) munmap(data, size);
+  }
+  FileMapping(const FileMapping &) = delete;
+  FileMapping &operator=(const FileMapping &) = delete;
+
+  uint8_t *release() {
+    uint8_t *released = data;
+    data = nullptr;
+    return released;
+  }
+
+  bool opened = false;
+  uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
+std::array<uint32_t, 256> crc32Table() {
+  std::array<uint32_t, 256> table;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    table[i] = crc;
+  }
+  return table;
+}
+
+}  // namespace
+
+uint32_t SHI::ConfigSnapshot::crc32(const uint8_t *data, size_t size) {
+  static const std::array<uint32_t, 256> table = crc32Table();
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFF;
+}
+
+uint32_t SHI::ConfigSnapshot::crc32(const std::string &data) {
+  return crc32(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+}
+
+SHI::ConfigSnapshot::SnapshotErrors SHI::ConfigSnapshot::write(
+    ConfigurationVisitor &visitor, const std::string &sourceJson,
+    const std::string &path) {
+  std::string json = visitor.toJson();
+  size_t capacity = json.size() * 2;
+  DynamicJsonDocument doc(capacity);
+  auto error = deserializeJson(doc, json);
+  while (error == DeserializationError::NoMemory) {
+    capacity *= 2;
+    doc = DynamicJsonDocument(capacity);
+    error = deserializeJson(doc, json);
+  }
+  if (error) return SnapshotErrors::FailureToDecode;
+
+  std::vector<uint8_t> payload(measureMsgPack(doc));
+  serializeMsgPack(doc, payload.data(), payload.size());
+  SnapshotHeader header = {};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.documentCapacity = doc.memoryUsage();
+  header.payloadSize = payload.size();
+  header.payloadCrc32 = crc32(payload.data(), payload.size());
+  header.sourceCrc32 = crc32(sourceJson);
+
+  std::ofstream outFile(path, std::ios::binary | std::ios::trunc);
+  if (!outFile) return SnapshotErrors::FailureToOpen;
+  outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outFile.write(reinterpret_cast<const char *>(payload.data()),
+                payload.size());
+  outFile.close();
+  return outFile ? SnapshotErrors::None : SnapshotErrors::FailureToWrite;
+}
+
+SHI::ConfigSnapshot::Snapshot::~Snapshot() {
+  if (mapping != nullptr) munmap(mapping, mappingSize);
+}
+
+SHI::ConfigSnapshot::SnapshotErrors SHI::ConfigSnapshot::read(
+    const std::string &path, std::unique_ptr<Snapshot> *snapshot) {
+  FileMapping file(path);
+  if (!file.opened) return SnapshotErrors::FailureToOpen;
+  if (file.data == nullptr || file.size < sizeof(SnapshotHeader))
+    return SnapshotErrors::InvalidHeader;
+  SnapshotHeader header;
+  memcpy(&header, file.data, sizeof(header));
+  if (header.magic != MAGIC) return SnapshotErrors::InvalidHeader;
+  if (header.version != VERSION) return SnapshotErrors::VersionMismatch;
+  if (header.payloadSize != file.size - sizeof(header))
+    return SnapshotErrors::InvalidHeader;
+  if (crc32(file.data + sizeof(header), header.payloadSize) !=
+      header.payloadCrc32)
+    return SnapshotErrors::ChecksumMismatch;
+
+  size_t size = file.size;
+  std::unique_ptr<Snapshot> result(
+      new Snapshot(file.release(), size, header));
+  // A non-const input makes ArduinoJson decode the strings in place
+  auto error = deserializeMsgPack(
+      result->doc, reinterpret_cast<char *>(result->mapping + sizeof(header)),
+      header.payloadSize);
+  if (error) return SnapshotErrors::FailureToDecode;
+  *snapshot = std::move(result);
+  return SnapshotErrors::None;
+}
+
+SHI::FactoryErrors SHI::ConfigSnapshot::construct(
+    Factory *factory, const std::string &snapshotPath,
+    const std::string &jsonFallback, SnapshotErrors *snapshotError) {
+  std::unique_ptr<Snapshot> snapshot;
+  auto error = read(snapshotPath, &snapshot);
+  if (error == SnapshotErrors::None &&
+      snapshot->getSourceCrc32() != crc32(jsonFallback))
+    error = SnapshotErrors::StaleSnapshot;
+  if (snapshotError != nullptr) *snapshotError = error;
+  if (error == SnapshotErrors::None)
+    return factory->getError(factory->construct(snapshot->root()));
+  return factory->getError(factory->construct(jsonFallback));
+}
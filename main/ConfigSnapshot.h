@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#pragma once
+
+#include <ArduinoJson.h>
+#include <SHIFactory.h>
+#include <SHIVisitor.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace SHI {
+
+/**
+ * Binary snapshot of a constructed configuration tree.
+ *
+ * The file is a fixed SnapshotHeader followed by the MessagePack encoding of
+ * the ConfigurationVisitor output. Loading maps the file copy-on-write and
+ * decodes the payload in place, so no JSON text is tokenized on startup and
+ * the strings of the document point into the mapping instead of being
+ * copied. The snapshot is a per-node cache in native byte order. It records
+ * the CRC of the JSON it was made from, so an edited configuration is not
+ * shadowed by an old snapshot.
+ */
+namespace ConfigSnapshot {
+
+const uint32_t MAGIC = 0x53494853;  // "SHIS" in little endian
+const uint16_t VERSION = 2;
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  // Capacity of the JsonDocument that is needed to decode the payload
+  uint32_t documentCapacity;
+  uint32_t payloadSize;
+  uint32_t payloadCrc32;
+  // CRC of the JSON text the snapshot was made from
+  uint32_t sourceCrc32;
+};
+
+enum class SnapshotErrors {
+  None,
+  FailureToOpen,
+  FailureToWrite,
+  InvalidHeader,
+  VersionMismatch,
+  ChecksumMismatch,
+  FailureToDecode,
+  StaleSnapshot
+};
+
+uint32_t crc32(const uint8_t *data, size_t size);
+uint32_t crc32(const std::string &data);
+
+/**
+ * Serializes the configuration collected by visitor into a snapshot file.
+ * sourceJson is the configuration the tree was constructed from.
+ */
+SnapshotErrors write(ConfigurationVisitor &visitor,
+                     const std::string &sourceJson, const std::string &path);
+
+/**
+ * A decoded snapshot. The strings of the document live in the private
+ * mapping of the file, so the mapping is kept for the lifetime of the
+ * document.
+ */
+class Snapshot {
+ public:
+  Snapshot(uint8_t *mapping, size_t mappingSize, const SnapshotHeader &header)
+      : mapping(mapping),
+        mappingSize(mappingSize),
+        sourceCrc32(header.sourceCrc32),
+        doc(header.documentCapacity) {}
+  ~Snapshot();
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(const Snapshot &) = delete;
+
+  JsonObject root() { return doc.as<JsonObject>(); }
+  uint32_t getSourceCrc32() const { return sourceCrc32; }
+
+ private:
+  friend SnapshotErrors read(const std::string &path,
+                             std::unique_ptr<Snapshot> *snapshot);
+  uint8_t *mapping;
+  size_t mappingSize;
+  uint32_t sourceCrc32;
+  DynamicJsonDocument doc;
+};
+
+/**
+ * Maps and decodes the snapshot at path. The document is sized from the
+ * snapshot header.
+ */
+SnapshotErrors read(const std::string &path,
+                    std::unique_ptr<Snapshot> *snapshot);
+
+/**
+ * Constructs the tree from the snapshot at snapshotPath. When the snapshot
+ * is missing, its version or checksum does not match, or it was made from
+ * another JSON than jsonFallback, jsonFallback is constructed instead. If
+ * snapshotError is not null, it receives the reason why the snapshot was not
+ * used.
+ */
+FactoryErrors construct(Factory *factory, const std::string &snapshotPath,
+                        const std::string &jsonFallback,
+                        SnapshotErrors *snapshotError = nullptr);
+
+}  // namespace ConfigSnapshot
+
+}  // namespace SHI
@@ -6,6 +6,8 @@
 //  Copyright © 2020 Karsten Becker. All rights reserved.
 //
 
+#pragma once
+
 #include "SHICommunicator.h"
 #include "SHIHardware.h"
 #include "SHISensor.h"
@@ -16,7 +18,6 @@ class DummySensor : public SHI::Sensor {
   DummySensor() : Sensor("Dummy") {}
 
   std::vector<SHI::MeasurementBundle> readSensor() override {
-    static int count = 0;
     SHI::hw->logInfo(name, __func__, "Loop Dummy Sensor");
     auto humMeasure = humidty->measuredFloat(humidtyValue);
     SHI::Measurement tempMeasure =
@@ -47,6 +48,7 @@ class DummySensor : public SHI::Sensor {
   bool reconfigure(SHI::Configuration *newConfig) override { return true; }
 
  private:
+  int count = 0;
 };
 class PrintHierachyVisitor : public SHI::Visitor {
  public:
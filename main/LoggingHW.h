@@ -15,6 +15,8 @@
 #include <iostream>
 #include <string>
 
+#include "Simulator.h"
+
 namespace SHI {
 
 class LoggingHardwareConfig : public SHI::Configuration {
@@ -72,6 +74,7 @@ class LoggingHardware : public SHI::Hardware {
     log((std::string("ERROR: ") + name + "." + func + "() " + message).c_str());
   }
   int64_t getEpochInMs() override {
+    if (simulatedClock != nullptr) return simulatedClock->now();
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return (tv.tv_sec * 1000LL + (tv.tv_usec / 1000LL));
@@ -82,11 +85,17 @@ class LoggingHardware : public SHI::Hardware {
     return true;
   }
   const char *resetReason = "NONE";
+  // Use a simulated clock instead of the system time, nullptr to reset
+  void setClock(SimulatedClock *clock) { simulatedClock = clock; }
+  // Redirect the log output, nullptr discards it
+  void setLogStream(std::ostream *stream) { logStream = stream; }
 
  protected:
   LoggingHardwareConfig config;
+  SimulatedClock *simulatedClock = nullptr;
+  std::ostream *logStream = &std::cout;
   void log(const std::string &message) override {
-    std::cout << message << std::endl;
+    if (logStream != nullptr) *logStream << message << std::endl;
   };
 };
 
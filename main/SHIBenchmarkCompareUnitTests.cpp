@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <string>
+#include <vector>
+
+#include "BenchmarkCompare.h"
+#include "gtest/gtest.h"
+
+using SHI::BenchmarkCompare::CompareErrors;
+
+class BenchmarkCompareTest : public ::testing::Test {
+ public:
+  std::string benchmarkJson(double publishTime, double constructTime,
+                            const char *constructUnit = "ns") {
+    return std::string(
+               "{\"context\":{\"num_cpus\":8},\"benchmarks\":["
+               "{\"name\":\"BM_BusPublish/8\",\"run_type\":\"iteration\","
+               "\"cpu_time\":") +
+           std::to_string(publishTime) +
+           ",\"time_unit\":\"ns\"},"
+           "{\"name\":\"BM_FactoryConstruct\",\"run_type\":\"iteration\","
+           "\"cpu_time\":" +
+           std::to_string(constructTime) + ",\"time_unit\":\"" +
+           constructUnit + "\"}]}";
+  }
+  std::string repeatedJson(double mean, double median, double stddev) {
+    std::string json = "{\"benchmarks\":[";
+    // The iteration runs of the repetitions are far slower than the mean
+    for (int i = 0; i < 3; i++)
+      json +=
+          "{\"name\":\"BM_BusPublish/8\",\"run_type\":\"iteration\","
+          "\"cpu_time\":" +
+          std::to_string(mean * (i + 2)) + ",\"time_unit\":\"ns\"},";
+    return json + aggregateJson("mean", mean) + "," +
+           aggregateJson("median", median) + "," +
+           aggregateJson("stddev", stddev) + "]}";
+  }
+  std::string aggregateJson(const std::string &aggregate, double time) {
+    return "{\"name\":\"BM_BusPublish/8_" + aggregate +
+           "\",\"run_type\":\"aggregate\",\"aggregate_name\":\"" +
+           aggregate + "\",\"cpu_time\":" + std::to_string(time) +
+           ",\"time_unit\":\"ns\"}";
+  }
+  CompareErrors compare(const std::string &baseline,
+                        const std::string &current, double threshold = 0.1,
+                        bool allowMissing = false) {
+    results.clear();
+    missing.clear();
+    failed.clear();
+    return SHI::BenchmarkCompare::compare(baseline, current, threshold,
+                                          allowMissing, &results, &missing,
+                                          &failed);
+  }
+
+  std::vector<SHI::BenchmarkCompare::Result> results;
+  std::vector<std::string> missing;
+  std::vector<std::string> failed;
+};
+
+TEST_F(BenchmarkCompareTest, invalidInput) {
+  ASSERT_EQ(compare("404 Website not found", benchmarkJson(100, 1000)),
+            CompareErrors::FailureToParseBaseline);
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), "{}"),
+            CompareErrors::FailureToParseCurrent);
+}
+
+TEST_F(BenchmarkCompareTest, thresholds) {
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(105, 900)),
+            CompareErrors::None);
+  ASSERT_EQ(results.size(), 2);
+  ASSERT_FALSE(results[0].regressed);
+  ASSERT_NEAR(results[0].change, 0.05, 1e-9);
+  ASSERT_NEAR(results[1].change, -0.1, 1e-9);
+
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(120, 1000)),
+            CompareErrors::Regression);
+  ASSERT_EQ(results[0].name, "BM_BusPublish/8");
+  ASSERT_TRUE(results[0].regressed);
+  ASSERT_FALSE(results[1].regressed);
+
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(120, 1000), 0.25),
+            CompareErrors::None);
+}
+
+TEST_F(BenchmarkCompareTest, timeUnits) {
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(100, 1, "us")),
+            CompareErrors::None);
+  ASSERT_NEAR(results[1].current, 1000, 1e-9);
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(100, 1, "ms")),
+            CompareErrors::Regression);
+  ASSERT_NEAR(results[1].current, 1e6, 1e-9);
+}
+
+TEST_F(BenchmarkCompareTest, missingBenchmarks) {
+  std::string onlyPublish =
+      "{\"benchmarks\":[{\"name\":\"BM_BusPublish/8\","
+      "\"run_type\":\"iteration\",\"cpu_time\":100,"
+      "\"time_unit\":\"ns\"}]}";
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), onlyPublish),
+            CompareErrors::MissingBenchmark);
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_EQ(missing.size(), 1);
+  ASSERT_EQ(missing[0], "BM_FactoryConstruct");
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), onlyPublish, 0.1, true),
+            CompareErrors::None);
+  ASSERT_EQ(missing.size(), 1);
+  // A missing benchmark doesn't hide a regression
+  ASSERT_EQ(compare(benchmarkJson(50, 1000), onlyPublish, 0.1, true),
+            CompareErrors::Regression);
+  // New benchmarks are not compared
+  ASSERT_EQ(compare(onlyPublish, benchmarkJson(100, 1000)),
+            CompareErrors::None);
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_EQ(missing.size(), 0);
+}
+
+TEST_F(BenchmarkCompareTest, failedBenchmarks) {
+  std::string errored =
+      "{\"benchmarks\":[{\"name\":\"BM_BusPublish/8\","
+      "\"run_type\":\"iteration\",\"cpu_time\":100,"
+      "\"time_unit\":\"ns\"},{\"name\":\"BM_FactoryConstruct\","
+      "\"run_type\":\"iteration\",\"error_occurred\":true,"
+      "\"error_message\":\"Construction failed\",\"cpu_time\":1,"
+      "\"time_unit\":\"ns\"}]}";
+  // A failed benchmark is not reported as missing, and it isn't an
+  // improvement either
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), errored, 0.1, true),
+            CompareErrors::BenchmarkFailed);
+  ASSERT_EQ(failed.size(), 1);
+  ASSERT_EQ(failed[0], "BM_FactoryConstruct");
+  ASSERT_EQ(missing.size(), 0);
+  ASSERT_EQ(results.size(), 1);
+  // It fails the comparison when it is the baseline, too
+  ASSERT_EQ(compare(errored, benchmarkJson(100, 1000)),
+            CompareErrors::BenchmarkFailed);
+
+  std::string noTime =
+      "{\"benchmarks\":[{\"name\":\"BM_BusPublish/8\","
+      "\"run_type\":\"iteration\",\"time_unit\":\"ns\"},"
+      "{\"name\":\"BM_FactoryConstruct\",\"run_type\":\"iteration\","
+      "\"cpu_time\":1000,\"time_unit\":\"ns\"}]}";
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), noTime),
+            CompareErrors::BenchmarkFailed);
+  ASSERT_EQ(failed.size(), 1);
+  ASSERT_EQ(failed[0], "BM_BusPublish/8");
+  ASSERT_EQ(results.size(), 1);
+  // A baseline without a positive time would never regress
+  ASSERT_EQ(compare(benchmarkJson(0, 1000), benchmarkJson(1e9, 1000)),
+            CompareErrors::BenchmarkFailed);
+  ASSERT_EQ(failed.size(), 1);
+  ASSERT_EQ(failed[0], "BM_BusPublish/8");
+  ASSERT_EQ(compare(benchmarkJson(-1, 1000), benchmarkJson(100, 1000)),
+            CompareErrors::BenchmarkFailed);
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), benchmarkJson(0, 1000)),
+            CompareErrors::BenchmarkFailed);
+}
+
+TEST_F(BenchmarkCompareTest, aggregatesOnly) {
+  ASSERT_EQ(compare(repeatedJson(100, 100, 5), repeatedJson(105, 95, 50)),
+            CompareErrors::None);
+  // Neither the iteration runs nor the stddev are compared
+  ASSERT_EQ(results.size(), 2);
+  ASSERT_EQ(results[0].name, "BM_BusPublish/8_mean");
+  ASSERT_NEAR(results[0].change, 0.05, 1e-9);
+  ASSERT_EQ(results[1].name, "BM_BusPublish/8_median");
+  ASSERT_NEAR(results[1].change, -0.05, 1e-9);
+  ASSERT_EQ(compare(repeatedJson(100, 100, 5), repeatedJson(100, 120, 5)),
+            CompareErrors::Regression);
+  ASSERT_FALSE(results[0].regressed);
+  ASSERT_TRUE(results[1].regressed);
+  // Iteration runs in the baseline can't be matched with aggregates
+  ASSERT_EQ(compare(benchmarkJson(100, 1000), repeatedJson(100, 100, 5)),
+            CompareErrors::MissingBenchmark);
+  ASSERT_EQ(missing.size(), 2);
+}
@@ -0,0 +1,29 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "DummySensor.h"
+#include "LoggingComms.h"
+#include "LoggingHW.h"
+
+static void BM_LoggingCommunicatorNewReading(benchmark::State &state) {
+  SHI::LoggingHardware hardware;
+  hardware.setLogStream(nullptr);
+  SHI::hw = &hardware;
+  DummySensor sensor;
+  sensor.setupSensor();
+  std::vector<SHI::MeasurementBundle> readings = sensor.readSensor();
+  LoggingCommunicator communicator;
+  for (auto _ : state) {
+    communicator.newReading(readings[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * readings[0].data.size());
+  SHI::hw = nullptr;
+}
+BENCHMARK(BM_LoggingCommunicatorNewReading);
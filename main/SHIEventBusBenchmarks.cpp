@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SHIEventBus.h"
+
+using SHI::EventBus::Bus;
+using SHI::EventBus::EventBuilder;
+using SHI::EventBus::Subscriber;
+using SHI::EventBus::SubscriberBuilder;
+
+using SHI::EventBus::DataType;
+using SHI::EventBus::EventType;
+using SHI::EventBus::SourceType;
+
+namespace {
+
+std::shared_ptr<SHI::EventBus::Event> sensorEvent() {
+  return EventBuilder::source(SourceType::SENSOR)
+      .event(EventType::DATA)
+      .data(DataType::STRING)
+      .customField(0xF0)
+      .hash("BME680")
+      .build(std::make_shared<std::string>("Hello World!"));
+}
+
+}  // namespace
+
+static void BM_BusPublish(benchmark::State &state) {
+  auto bus = Bus::get();
+  auto event = sensorEvent();
+  std::vector<std::shared_ptr<Subscriber>> subscribers;
+  for (int i = 0; i < state.range(0); i++) {
+    // Every other subscriber does not match the event
+    auto subscriber =
+        i % 2 == 0
+            ? SubscriberBuilder::forEvent(*event).build()
+            : SubscriberBuilder::forEvent(*event).setHashedName(i).build();
+    bus->subscribe(subscriber);
+    subscribers.push_back(subscriber);
+  }
+  int published = 0;
+  for (auto _ : state) {
+    bus->publish(event);
+    if (++published % 1024 == 0) {
+      // Releasing the delivered events is not part of publishing
+      state.PauseTiming();
+      for (auto &&subscriber : subscribers) subscriber->inbox.clear();
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  bus->reset();
+}
+BENCHMARK(BM_BusPublish)->Arg(1)->Arg(8)->Arg(64);
+
+static void BM_SubscriberMatches(benchmark::State &state) {
+  auto event = sensorEvent();
+  auto everything = SubscriberBuilder::everything().build();
+  auto masked = SubscriberBuilder::empty()
+                    .allSources()
+                    .allEvents()
+                    .allDataTypes()
+                    .allHashedNames()
+                    .addCustomFieldMask(0x1)
+                    .addCustomFieldMask(0x2)
+                    .build();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(everything->matches(*event));
+    benchmark::DoNotOptimize(masked->matches(*event));
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_SubscriberMatches);
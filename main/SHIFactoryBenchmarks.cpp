@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "ConfigSnapshot.h"
+#include "SHIFactory.h"
+#include "TestFactories.h"
+#ifndef BASE_PATH
+#define BASE_PATH "json/"
+#endif
+
+namespace {
+
+/**
+ * Returns the configuration the benchmarks construct. Without it every
+ * benchmark would measure a failing construction, so a missing file aborts
+ * the run.
+ */
+const std::string &constructJson() {
+  static const std::string json = loadFile(BASE_PATH "in/construct.json");
+  if (json.empty()) {
+    std::cerr << "Failed to load " BASE_PATH "in/construct.json" << std::endl;
+    std::exit(1);
+  }
+  return json;
+}
+
+void resetFactory() {
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+  registerTestFactories(true);
+}
+
+}  // namespace
+
+static void BM_FactoryConstruct(benchmark::State &state) {
+  const std::string &json = constructJson();
+  for (auto _ : state) {
+    state.PauseTiming();
+    resetFactory();
+    auto factory = SHI::Factory::get();
+    state.ResumeTiming();
+    if (factory->getError(factory->construct(json)) !=
+        SHI::FactoryErrors::None) {
+      state.SkipWithError("Construction failed");
+      break;
+    }
+  }
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+}
+BENCHMARK(BM_FactoryConstruct);
+
+static void BM_SnapshotConstruct(benchmark::State &state) {
+  std::string snapshotFile = tempFile("benchmark.snapshot");
+  const std::string &json = constructJson();
+  resetFactory();
+  auto factory = SHI::Factory::get();
+  if (factory->getError(factory->construct(json)) !=
+      SHI::FactoryErrors::None) {
+    state.SkipWithError("Construction failed");
+    return;
+  }
+  SHI::ConfigurationVisitor visitor;
+  SHI::hw->accept(visitor);
+  if (SHI::ConfigSnapshot::write(visitor, json, snapshotFile) !=
+      SHI::ConfigSnapshot::SnapshotErrors::None) {
+    state.SkipWithError("Failed to write the snapshot");
+    return;
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    resetFactory();
+    factory = SHI::Factory::get();
+    state.ResumeTiming();
+    auto snapshotError = SHI::ConfigSnapshot::SnapshotErrors::None;
+    if (SHI::ConfigSnapshot::construct(factory, snapshotFile, json,
+                                       &snapshotError) !=
+            SHI::FactoryErrors::None ||
+        snapshotError != SHI::ConfigSnapshot::SnapshotErrors::None) {
+      state.SkipWithError("Snapshot construction failed");
+      break;
+    }
+  }
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+}
+BENCHMARK(BM_SnapshotConstruct);
+
+static void BM_ConfigurationVisitorToJson(benchmark::State &state) {
+  resetFactory();
+  auto factory = SHI::Factory::get();
+  if (factory->getError(factory->construct(constructJson())) !=
+      SHI::FactoryErrors::None) {
+    state.SkipWithError("Construction failed");
+    return;
+  }
+  for (auto _ : state) {
+    SHI::ConfigurationVisitor visitor;
+    SHI::hw->accept(visitor);
+    benchmark::DoNotOptimize(visitor.toJson());
+  }
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+}
+BENCHMARK(BM_ConfigurationVisitorToJson);
@@ -6,41 +6,29 @@
 
 #include <time.h>
 
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 
+#include "ConfigSnapshot.h"
 #include "DummySensor.h"
 #include "LoggingComms.h"
 #include "LoggingHW.h"
 #include "SHIBus.h"
 #include "SHIFactory.h"
+#include "TestFactories.h"
 #include "gtest/gtest.h"
 #ifndef BASE_PATH
-#define BASE_PATH "/Users/karstenbecker/PlatformIO/Projects/SHITTests/json/"
+#define BASE_PATH "json/"
 #endif
 class FactoryTest : public ::testing::Test {
  public:
-  void registerDefaultFactories() {
-    auto factory = SHI::Factory::get();
-    ASSERT_NE(factory, nullptr);
-    ASSERT_TRUE(factory->registerFactory("hw", [=](JsonObject obj) {
-      auto resObj = new SHI::LoggingHardware();
-      return factory->defaultHardwareFactory(resObj, obj);
-    }));
-    ASSERT_TRUE(
-        factory->registerFactory("LoggingCommunicator", [=](JsonObject obj) {
-          auto resObj = new LoggingCommunicator();
-          return factory->objToResult(resObj);
-        }));
-    ASSERT_TRUE(factory->registerFactory("sensorGroup", [=](JsonObject obj) {
-      return factory->defaultSensorGroupFactory(obj);
-    }));
-    ASSERT_TRUE(factory->registerFactory("Dummy", [=](JsonObject obj) {
-      return factory->objToResult(new DummySensor());
-    }));
-  }
+  void registerDefaultFactories() { ASSERT_TRUE(registerTestFactories()); }
   StaticJsonDocument<50000> doc;
   JsonObject getJson(std::string json) {
     doc.clear();
@@ -48,16 +36,7 @@ class FactoryTest : public ::testing::Test {
     return doc.as<JsonObject>();
   }
 
-  std::string loadFile(const char* fileName) {
-    std::ifstream inFile;
-    inFile.open(fileName);  // open the input file
-
-    std::stringstream strStream;
-    strStream << inFile.rdbuf();  // read the file
-    return strStream.str();       // str holds the content of the file
-  }
-
-  void writeFile(const char* fileName, std::string value) {
+  void writeFile(const std::string& fileName, std::string value) {
     std::ofstream outFile;
     outFile.open(fileName);
     outFile << value;
@@ -102,9 +81,118 @@ TEST_F(FactoryTest, loadConfig) {
   SHI::ConfigurationVisitor visitor;
   SHI::hw->accept(visitor);
   std::string visitorResult = visitor.toJson();
-  writeFile(BASE_PATH "out/visitorResult.json", visitorResult);
+  writeFile(tempFile("visitorResult.json"), visitorResult);
   std::string jsonExpected = loadFile(BASE_PATH "out/construct.json");
   ASSERT_STREQ(visitorResult.c_str(), jsonExpected.c_str());
 }
 
+TEST_F(FactoryTest, snapshotMatchesJson) {
+  std::string json = loadFile(BASE_PATH "in/construct.json");
+  registerDefaultFactories();
+  auto factory = SHI::Factory::get();
+  ASSERT_EQ(factory->getError(factory->construct(json)),
+            SHI::FactoryErrors::None);
+  PrintHierachyVisitor jsonPrinter;
+  SHI::hw->accept(jsonPrinter);
+  SHI::ConfigurationVisitor visitor;
+  SHI::hw->accept(visitor);
+  std::string snapshotFile = tempFile("construct.snapshot");
+  ASSERT_EQ(SHI::ConfigSnapshot::write(visitor, json, snapshotFile),
+            SHI::ConfigSnapshot::SnapshotErrors::None);
+
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+  registerDefaultFactories();
+  factory = SHI::Factory::get();
+  auto snapshotError = SHI::ConfigSnapshot::SnapshotErrors::FailureToOpen;
+  ASSERT_EQ(SHI::ConfigSnapshot::construct(factory, snapshotFile, json,
+                                           &snapshotError),
+            SHI::FactoryErrors::None);
+  ASSERT_EQ(snapshotError, SHI::ConfigSnapshot::SnapshotErrors::None);
+  PrintHierachyVisitor snapshotPrinter;
+  SHI::hw->accept(snapshotPrinter);
+  ASSERT_STREQ(snapshotPrinter.result.c_str(), jsonPrinter.result.c_str());
+  std::string printResult = loadFile(BASE_PATH "out/printVisitor.txt");
+  ASSERT_STREQ(snapshotPrinter.result.c_str(), printResult.c_str());
+}
+
+TEST_F(FactoryTest, snapshotFallsBackToJson) {
+  std::string json = loadFile(BASE_PATH "in/construct.json");
+  std::string printResult = loadFile(BASE_PATH "out/printVisitor.txt");
+  registerDefaultFactories();
+  auto factory = SHI::Factory::get();
+  ASSERT_EQ(factory->getError(factory->construct(json)),
+            SHI::FactoryErrors::None);
+  SHI::ConfigurationVisitor visitor;
+  SHI::hw->accept(visitor);
+  std::string snapshotFile = tempFile("fallback.snapshot");
+  ASSERT_EQ(SHI::ConfigSnapshot::write(visitor, json, snapshotFile),
+            SHI::ConfigSnapshot::SnapshotErrors::None);
+  std::string snapshot = loadFile(snapshotFile.c_str());
+  ASSERT_GT(snapshot.size(), sizeof(SHI::ConfigSnapshot::SnapshotHeader));
+
+  std::string corrupted = snapshot;
+  corrupted.back() ^= 0xFF;
+  std::string wrongVersion = snapshot;
+  wrongVersion[offsetof(SHI::ConfigSnapshot::SnapshotHeader, version)] ^= 0xFF;
+  std::string wrongMagic = snapshot;
+  wrongMagic[offsetof(SHI::ConfigSnapshot::SnapshotHeader, magic)] ^= 0xFF;
+  std::string truncated =
+      snapshot.substr(0, sizeof(SHI::ConfigSnapshot::SnapshotHeader) - 1);
+  // A valid header with a checksum that matches an invalid MessagePack byte
+  SHI::ConfigSnapshot::SnapshotHeader header;
+  memcpy(&header, snapshot.data(), sizeof(header));
+  const uint8_t invalidPayload = 0xC1;
+  header.payloadSize = 1;
+  header.payloadCrc32 = SHI::ConfigSnapshot::crc32(&invalidPayload, 1);
+  std::string undecodable(reinterpret_cast<const char*>(&header),
+                          sizeof(header));
+  undecodable += static_cast<char>(invalidPayload);
+  std::pair<std::string, SHI::ConfigSnapshot::SnapshotErrors> cases[] = {
+      {corrupted, SHI::ConfigSnapshot::SnapshotErrors::ChecksumMismatch},
+      {wrongVersion, SHI::ConfigSnapshot::SnapshotErrors::VersionMismatch},
+      {wrongMagic, SHI::ConfigSnapshot::SnapshotErrors::InvalidHeader},
+      {truncated, SHI::ConfigSnapshot::SnapshotErrors::InvalidHeader},
+      {"", SHI::ConfigSnapshot::SnapshotErrors::InvalidHeader},
+      {undecodable, SHI::ConfigSnapshot::SnapshotErrors::FailureToDecode},
+      {"<missing>", SHI::ConfigSnapshot::SnapshotErrors::FailureToOpen}};
+  for (auto&& testCase : cases) {
+    if (testCase.first == "<missing>")
+      std::remove(snapshotFile.c_str());
+    else
+      writeFile(snapshotFile, testCase.first);
+    SHI::hw = nullptr;
+    SHI::Factory::reset();
+    registerDefaultFactories();
+    factory = SHI::Factory::get();
+    auto snapshotError = SHI::ConfigSnapshot::SnapshotErrors::None;
+    ASSERT_EQ(SHI::ConfigSnapshot::construct(factory, snapshotFile, json,
+                                             &snapshotError),
+              SHI::FactoryErrors::None);
+    ASSERT_EQ(snapshotError, testCase.second);
+    PrintHierachyVisitor printer;
+    SHI::hw->accept(printer);
+    ASSERT_STREQ(printer.result.c_str(), printResult.c_str());
+  }
+
+  // The snapshot is valid, but the JSON was edited after it was written
+  writeFile(snapshotFile, snapshot);
+  std::string edited = json;
+  size_t channel = edited.find("OutsideChannel");
+  ASSERT_NE(channel, std::string::npos);
+  edited.replace(channel, strlen("OutsideChannel"), "GardenChannel");
+  SHI::hw = nullptr;
+  SHI::Factory::reset();
+  registerDefaultFactories();
+  factory = SHI::Factory::get();
+  auto snapshotError = SHI::ConfigSnapshot::SnapshotErrors::None;
+  ASSERT_EQ(SHI::ConfigSnapshot::construct(factory, snapshotFile, edited,
+                                           &snapshotError),
+            SHI::FactoryErrors::None);
+  ASSERT_EQ(snapshotError, SHI::ConfigSnapshot::SnapshotErrors::StaleSnapshot);
+  PrintHierachyVisitor printer;
+  SHI::hw->accept(printer);
+  ASSERT_NE(printer.result.find("CH:GardenChannel"), std::string::npos);
+}
+
 // TEST_F(FactoryTest, generateJSONConfig) { registerDefaultFactories(); }
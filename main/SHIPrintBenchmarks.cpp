@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <benchmark/benchmark.h>
+#include <time.h>
+
+#include "SHIPrint.h"
+
+class NullPrinter : public SHI::Print {
+ public:
+  size_t write(const uint8_t* buffer, size_t size) {
+    written += size;
+    return size;
+  }
+  size_t write(uint8_t value) {
+    written++;
+    return sizeof(char);
+  }
+  size_t written = 0;
+};
+
+static void BM_PrintInteger(benchmark::State& state) {
+  NullPrinter printer;
+  for (auto _ : state) {
+    printer.print(-123456789);
+    printer.print(0xFFFFFFFFFF, 16);
+  }
+  benchmark::DoNotOptimize(printer.written);
+}
+BENCHMARK(BM_PrintInteger);
+
+static void BM_PrintFloat(benchmark::State& state) {
+  NullPrinter printer;
+  for (auto _ : state) {
+    printer.print(3.14);
+    printer.print(-1234.5678, 5);
+  }
+  benchmark::DoNotOptimize(printer.written);
+}
+BENCHMARK(BM_PrintFloat);
+
+static void BM_Printf(benchmark::State& state) {
+  NullPrinter printer;
+  for (auto _ : state) {
+    // Output longer than 32 characters is allocated dynamically
+    printer.printf("%s=%d", "Humidity", 42);
+    printer.printf(
+        "Hello, this is longer than 32 characters. This allows testing "
+        "the %s allocation.",
+        "dynamic");
+  }
+  benchmark::DoNotOptimize(printer.written);
+}
+BENCHMARK(BM_Printf);
+
+static void BM_PrintTime(benchmark::State& state) {
+  NullPrinter printer;
+  const time_t epoch = 1583835687;
+  struct tm* now = gmtime(&epoch);  // NOLINT
+  for (auto _ : state) {
+    printer.println(now, "%F %T");
+  }
+  benchmark::DoNotOptimize(printer.written);
+}
+BENCHMARK(BM_PrintTime);
@@ -0,0 +1,296 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DummySensor.h"
+#include "LoggingHW.h"
+#include "SHIFactory.h"
+#include "Simulator.h"
+#include "TestFactories.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+const int64_t SECOND = 1000;
+const int64_t MINUTE = 60 * SECOND;
+const int64_t HOUR = 60 * MINUTE;
+// Tue Mar 10 10:21:27 2020
+const int64_t START = 1583835687000;
+
+}  // namespace
+
+class SimulationTest : public ::testing::Test {
+ public:
+  SimulationTest() : clock(START), simulator(&clock) {}
+  void SetUp() override {
+    hardware.setClock(&clock);
+    hardware.setLogStream(nullptr);
+    SHI::hw = &hardware;
+  }
+  void TearDown() override { SHI::hw = nullptr; }
+
+  int readAndCountNoData(DummySensor *sensor) {
+    int noData = 0;
+    for (auto &&bundle : sensor->readSensor())
+      for (auto &&data : bundle.data)
+        if (data.getDataState() != SHI::MeasurementDataState::VALID) noData++;
+    return noData;
+  }
+
+  SHI::SimulatedClock clock;
+  SHI::Simulator simulator;
+  SHI::LoggingHardware hardware;
+};
+
+TEST_F(SimulationTest, clockDrivesHardware) {
+  ASSERT_EQ(hardware.getEpochInMs(), START);
+  clock.advance(HOUR);
+  ASSERT_EQ(hardware.getEpochInMs(), START + HOUR);
+  hardware.setClock(nullptr);
+  ASSERT_NE(hardware.getEpochInMs(), START + HOUR);
+}
+
+TEST_F(SimulationTest, eventOrdering) {
+  std::string order;
+  simulator.scheduleIn(30, [&]() { order += "c"; });
+  simulator.scheduleIn(10, [&]() { order += "a"; });
+  simulator.scheduleIn(10, [&]() { order += "b"; });
+  simulator.schedule(START + 20, [&]() {
+    order += std::to_string(hardware.getEpochInMs() - START);
+  });
+  ASSERT_EQ(simulator.runFor(15), 2);
+  ASSERT_EQ(clock.now(), START + 15);
+  ASSERT_EQ(simulator.runFor(15), 2);
+  ASSERT_EQ(order, "ab20c");
+  ASSERT_EQ(simulator.pending(), 0);
+}
+
+TEST_F(SimulationTest, clockNeverMovesBackwards) {
+  int64_t ranAt = 0;
+  simulator.schedule(START - HOUR, [&]() { ranAt = hardware.getEpochInMs(); });
+  ASSERT_EQ(simulator.runUntil(START - MINUTE), 1);
+  ASSERT_EQ(ranAt, START);
+  ASSERT_EQ(clock.now(), START);
+  clock.set(START - SECOND);
+  clock.advance(-SECOND);
+  ASSERT_EQ(hardware.getEpochInMs(), START);
+}
+
+TEST_F(SimulationTest, everyRejectsNonPositivePeriods) {
+  int runs = 0;
+  ASSERT_FALSE(simulator.every(0, [&]() { runs++; }));
+  ASSERT_FALSE(simulator.every(-SECOND, [&]() { runs++; }));
+  ASSERT_EQ(simulator.pending(), 0);
+  ASSERT_TRUE(simulator.every(SECOND, [&]() { runs++; }));
+  ASSERT_EQ(simulator.runFor(MINUTE), 60);
+  ASSERT_EQ(runs, 60);
+}
+
+TEST_F(SimulationTest, sensorThroughput) {
+  DummySensor first;
+  DummySensor second;
+  int readings = 0;
+  int firstNoData = 0;
+  int secondNoData = 0;
+  simulator.every(SECOND, [&]() {
+    firstNoData += readAndCountNoData(&first);
+    secondNoData += readAndCountNoData(&second);
+    readings++;
+  });
+  ASSERT_EQ(simulator.runFor(6 * HOUR), 6 * 3600);
+  ASSERT_EQ(readings, 6 * 3600);
+  // Each sensor reports no temperature for 2 out of 12 loops, independent of
+  // the other sensor
+  ASSERT_EQ(firstNoData, 6 * 3600 / 6);
+  ASSERT_EQ(secondNoData, firstNoData);
+}
+
+struct Recording {
+  std::vector<int64_t> loopTimes;
+  // Time of each forwarded reading and how many of its measurements had no
+  // data
+  std::vector<std::pair<int64_t, int>> readings;
+  // Readings that arrived within minInterval of the last forwarded one
+  int dropped = 0;
+  // First loop that saw no reading for longer than the deadline
+  int64_t timedOutAt = 0;
+};
+
+/**
+ * Records what the hardware loop delivers. Like an uplink with a quota it
+ * forwards at most one reading every minInterval ms, and it reports a
+ * timeout when no reading arrived for deadline ms.
+ */
+class RecordingCommunicator : public SHI::Communicator {
+ public:
+  RecordingCommunicator(int64_t minInterval, int64_t deadline)
+      : Communicator("RecordingCommunicator"),
+        minInterval(minInterval),
+        deadline(deadline) {}
+  void setupCommunication() override {
+    lastReading = SHI::hw->getEpochInMs();
+  }
+  void loopCommunication() override {
+    int64_t now = SHI::hw->getEpochInMs();
+    recording.loopTimes.push_back(now);
+    if (deadline > 0 && recording.timedOutAt == 0 &&
+        now - lastReading > deadline)
+      recording.timedOutAt = now;
+  }
+  void newReading(const SHI::MeasurementBundle &reading) override {
+    int64_t now = SHI::hw->getEpochInMs();
+    lastReading = now;
+    if (!recording.readings.empty() &&
+        now - recording.readings.back().first < minInterval) {
+      recording.dropped++;
+      return;
+    }
+    int noData = 0;
+    for (auto &&data : reading.data)
+      if (data.getDataState() != SHI::MeasurementDataState::VALID) noData++;
+    recording.readings.push_back({now, noData});
+  }
+  void newStatus(const SHI::Measurement &status, SHI::SHIObject *src) override {
+  }
+  const SHI::Configuration *getConfig() const override { return nullptr; }
+  bool reconfigure(SHI::Configuration *newConfig) override { return true; }
+
+  Recording recording;
+
+ private:
+  int64_t minInterval;
+  int64_t deadline;
+  int64_t lastReading = 0;
+};
+
+/**
+ * A sensor whose bus hangs at stallAt, from then on it delivers nothing.
+ */
+class StallingSensor : public DummySensor {
+ public:
+  explicit StallingSensor(int64_t stallAt) : stallAt(stallAt) {}
+  std::vector<SHI::MeasurementBundle> readSensor() override {
+    if (SHI::hw->getEpochInMs() >= stallAt) return {};
+    return DummySensor::readSensor();
+  }
+
+ private:
+  int64_t stallAt;
+};
+
+class HardwareLoopSimulationTest : public ::testing::Test {
+ public:
+  void TearDown() override {
+    SHI::hw = nullptr;
+    SHI::Factory::reset();
+  }
+
+  /**
+   * Builds a fresh tree with a Recording communicator and the given sensor
+   * on a new simulated clock, and runs the hardware loop every second for
+   * duration.
+   */
+  Recording simulate(int64_t duration,
+                     const std::string &recordingConfig = "{}",
+                     const std::string &sensor = "{\"Dummy\":{}}") {
+    SHI::hw = nullptr;
+    SHI::Factory::reset();
+    SHI::SimulatedClock clock(START);
+    SHI::Simulator simulator(&clock);
+    RecordingCommunicator *recorder = nullptr;
+    auto factory = SHI::Factory::get();
+    EXPECT_TRUE(registerTestFactories(true, &clock));
+    EXPECT_TRUE(factory->registerFactory("Recording", [&](JsonObject obj) {
+      recorder = new RecordingCommunicator(obj["minInterval"] | 0,
+                                           obj["deadline"] | 0);
+      return factory->objToResult(recorder);
+    }));
+    EXPECT_TRUE(factory->registerFactory("Stalling", [=](JsonObject obj) {
+      return factory->objToResult(
+          new StallingSensor(START + (obj["stallAfter"] | 0)));
+    }));
+    EXPECT_EQ(factory->getError(factory->construct(
+                  "{\"hw\":{\"$comms\":[{\"Recording\":" + recordingConfig +
+                  "}],\"$groups\":[{\"sensorGroup\":{\"name\":\"default\","
+                  "\"$sensors\":[" +
+                  sensor + "]}}]}}")),
+              SHI::FactoryErrors::None);
+    if (recorder == nullptr) return Recording();
+    SHI::hw->setup("Simulation");
+    simulator.every(SECOND, []() { SHI::hw->loop(); });
+    simulator.runFor(duration);
+    // The hardware keeps a pointer to the clock, don't let it dangle
+    SHI::hw = nullptr;
+    return recorder->recording;
+  }
+};
+
+TEST_F(HardwareLoopSimulationTest, loopRunsOnSimulatedTime) {
+  auto recording = simulate(HOUR);
+  ASSERT_EQ(recording.loopTimes.size(), 3600);
+  int64_t expectedTime = START;
+  for (auto &&loopTime : recording.loopTimes) {
+    expectedTime += SECOND;
+    ASSERT_EQ(loopTime, expectedTime);
+  }
+  ASSERT_GT(recording.readings.size(), 0);
+  int noData = 0;
+  for (auto &&reading : recording.readings) {
+    ASSERT_GT(reading.first, START);
+    ASSERT_LE(reading.first, START + HOUR);
+    ASSERT_EQ((reading.first - START) % SECOND, 0);
+    noData += reading.second;
+  }
+  // The dummy sensor has no temperature for 2 out of every 12 readings
+  int readings = recording.readings.size();
+  int remainder = readings % 12;
+  ASSERT_EQ(noData, readings / 12 * 2 + (remainder > 10 ? remainder - 10 : 0));
+}
+
+TEST_F(HardwareLoopSimulationTest, loopIsReproducible) {
+  auto first = simulate(6 * HOUR);
+  auto second = simulate(6 * HOUR);
+  ASSERT_GT(first.readings.size(), 0);
+  ASSERT_EQ(first.loopTimes, second.loopTimes);
+  ASSERT_EQ(first.readings, second.readings);
+}
+
+TEST_F(HardwareLoopSimulationTest, rateLimit) {
+  auto unlimited = simulate(HOUR);
+  auto recording = simulate(HOUR, "{\"minInterval\":60000}");
+  ASSERT_EQ(recording.loopTimes, unlimited.loopTimes);
+  // The sensor reads as often as without the limit, but only one reading a
+  // minute is forwarded
+  ASSERT_EQ(recording.readings.size() + recording.dropped,
+            unlimited.readings.size());
+  ASSERT_EQ(unlimited.dropped, 0);
+  ASSERT_GT(recording.dropped, 0);
+  ASSERT_EQ(recording.readings.size(), 60);
+  for (size_t i = 1; i < recording.readings.size(); i++)
+    ASSERT_GE(recording.readings[i].first - recording.readings[i - 1].first,
+              MINUTE)
+        << i;
+  ASSERT_EQ(recording.readings.back().first - recording.readings[0].first,
+            59 * MINUTE);
+}
+
+TEST_F(HardwareLoopSimulationTest, timeout) {
+  // A healthy sensor never runs into the deadline
+  ASSERT_EQ(simulate(2 * HOUR, "{\"deadline\":300000}").timedOutAt, 0);
+  auto recording =
+      simulate(2 * HOUR, "{\"deadline\":300000}",
+               "{\"Stalling\":{\"stallAfter\":3600000}}");
+  ASSERT_GT(recording.readings.size(), 0);
+  int64_t lastReading = recording.readings.back().first;
+  ASSERT_LT(lastReading, START + HOUR);
+  ASSERT_GE(lastReading, START + HOUR - MINUTE);
+  // The timeout is noticed by the first loop after the deadline
+  ASSERT_GT(recording.timedOutAt, lastReading + 5 * MINUTE);
+  ASSERT_LE(recording.timedOutAt, lastReading + 5 * MINUTE + SECOND);
+}
@@ -0,0 +1,297 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DummySensor.h"
+#include "LoggingComms.h"
+#include "LoggingHW.h"
+#include "SHIEventBus.h"
+#include "SHIFactory.h"
+#include "StatusEngine.h"
+#include "TestFactories.h"
+#include "gtest/gtest.h"
+
+using SHI::StatusLevel;
+using SHI::EventBus::DataType;
+using SHI::EventBus::EventBuilder;
+using SHI::EventBus::EventType;
+using SHI::EventBus::SourceType;
+using SHI::EventBus::SubscriberBuilder;
+
+class CollectingVisitor : public SHI::Visitor {
+ public:
+  void enterVisit(SHI::Sensor *sensor) override { sensors.push_back(sensor); }
+  void leaveVisit(SHI::Sensor *sensor) override {}
+  void enterVisit(SHI::SensorGroup *channel) override {
+    groups.push_back(channel);
+  }
+  void leaveVisit(SHI::SensorGroup *channel) override {}
+  void enterVisit(SHI::Hardware *harwdware) override {}
+  void leaveVisit(SHI::Hardware *harwdware) override {}
+  void visit(SHI::Communicator *communicator) override {}
+  void visit(SHI::MeasurementMetaData *data) override {}
+
+  std::vector<SHI::Sensor *> sensors;
+  std::vector<SHI::SensorGroup *> groups;
+};
+
+class CountingSensor : public DummySensor {
+ public:
+  SHI::Measurement getStatus() override {
+    statusReads++;
+    if (failing) return failure->measuredNoData();
+    return DummySensor::getStatus();
+  }
+  int statusReads = 0;
+  bool failing = false;
+  std::shared_ptr<SHI::MeasurementMetaData> failure =
+      std::make_shared<SHI::MeasurementMetaData>("Status", "",
+                                                 SHI::SensorDataType::FLOAT);
+};
+
+class StatusEngineTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(registerTestFactories());
+    auto factory = SHI::Factory::get();
+    ASSERT_TRUE(factory->registerFactory("Counting", [=](JsonObject obj) {
+      return factory->objToResult(new CountingSensor());
+    }));
+    ASSERT_TRUE(factory->registerFactory("StatusEngine", [=](JsonObject obj) {
+      registeredEngine = new SHI::StatusEngine();
+      return factory->objToResult(registeredEngine);
+    }));
+    lifecycle = SubscriberBuilder::empty()
+                    .allSources()
+                    .addEvent(EventType::LIFECYCLE)
+                    .allDataTypes()
+                    .allHashedNames()
+                    .allCustomFields()
+                    .build();
+    SHI::EventBus::Bus::get()->subscribe(lifecycle);
+  }
+
+  void TearDown() override {
+    SHI::hw = nullptr;
+    SHI::Factory::reset();
+    SHI::EventBus::Bus::get()->reset();
+  }
+
+  std::string generateTree(int groupCount, int sensorsPerGroup,
+                           const std::string &sensorType = "Dummy",
+                           bool withEngine = false) {
+    std::string json = "{\"hw\":{\"$comms\":[{\"LoggingCommunicator\":{}}";
+    if (withEngine) json += ",{\"StatusEngine\":{}}";
+    json += "],";
+    json += "\"$groups\":[";
+    for (int group = 0; group < groupCount; group++) {
+      if (group > 0) json += ",";
+      json += "{\"sensorGroup\":{\"name\":\"Group" + std::to_string(group) +
+              "\",\"$sensors\":[";
+      for (int sensor = 0; sensor < sensorsPerGroup; sensor++) {
+        if (sensor > 0) json += ",";
+        json += "{\"" + sensorType + "\":{}}";
+      }
+      json += "]}}";
+    }
+    json += "]}}";
+    return json;
+  }
+
+  void constructTree(int groupCount, int sensorsPerGroup,
+                     const std::string &sensorType = "Dummy") {
+    auto factory = SHI::Factory::get();
+    ASSERT_EQ(factory->getError(factory->construct(
+                  generateTree(groupCount, sensorsPerGroup, sensorType))),
+              SHI::FactoryErrors::None);
+    SHI::hw->accept(tree);
+    SHI::hw->accept(engine);
+  }
+
+  /**
+   * Subscribes to the transitions of the objects called name to level.
+   */
+  std::shared_ptr<SHI::EventBus::Subscriber> subscribeToStatus(
+      const char *name, StatusLevel level, int flags = 0) {
+    auto event = EventBuilder::source(SourceType::SENSOR)
+                     .event(EventType::LIFECYCLE)
+                     .data(DataType::STRING)
+                     .customField((1 << static_cast<int>(level)) | flags)
+                     .hash(name)
+                     .build(std::make_shared<std::string>(""));
+    auto subscriber = SubscriberBuilder::forEvent(*event).build();
+    SHI::EventBus::Bus::get()->subscribe(subscriber);
+    return subscriber;
+  }
+
+  std::shared_ptr<SHI::MeasurementMetaData> status =
+      std::make_shared<SHI::MeasurementMetaData>("Status", "",
+                                                 SHI::SensorDataType::FLOAT);
+  std::shared_ptr<SHI::EventBus::Subscriber> lifecycle;
+  CollectingVisitor tree;
+  SHI::StatusEngine engine;
+  SHI::StatusEngine *registeredEngine = nullptr;
+};
+
+TEST_F(StatusEngineTest, indexesTree) {
+  constructTree(2, 1);
+  // Hardware, communicator, two groups and two sensors
+  ASSERT_EQ(engine.trackedObjects(), 6);
+  ASSERT_EQ(engine.getTrackedStatus(tree.sensors[0]), StatusLevel::OK);
+  ASSERT_EQ(engine.getTrackedStatus(tree.groups[0]), StatusLevel::NO_DATA);
+  ASSERT_EQ(engine.getGroupHealth(tree.groups[0]), StatusLevel::OK);
+  ASSERT_EQ(engine.publishChanges(), 0);
+  ASSERT_EQ(lifecycle->inbox.size(), 0);
+}
+
+TEST_F(StatusEngineTest, publishesOnlyTransitions) {
+  constructTree(1, 2);
+  auto group = tree.groups[0];
+  engine.newStatus(status->measuredNoData(), tree.sensors[0]);
+  ASSERT_EQ(lifecycle->inbox.size(), 0) << "Nothing is published before";
+  ASSERT_EQ(engine.publishChanges(), 1);
+  // The sensor and the group health changed
+  ASSERT_EQ(lifecycle->inbox.size(), 2);
+  ASSERT_EQ(engine.getTrackedStatus(tree.sensors[0]), StatusLevel::NO_DATA);
+  ASSERT_EQ(engine.getGroupHealth(group), StatusLevel::NO_DATA);
+
+  engine.newStatus(status->measuredNoData(), tree.sensors[0]);
+  ASSERT_EQ(engine.publishChanges(), 1);
+  ASSERT_EQ(lifecycle->inbox.size(), 2);
+
+  engine.newStatus(status->measuredNoData(), tree.sensors[1]);
+  ASSERT_EQ(engine.publishChanges(), 1);
+  // The group health was already <NO_DATA>
+  ASSERT_EQ(lifecycle->inbox.size(), 3);
+
+  engine.newStatus(status->measuredFloat(1), tree.sensors[0]);
+  engine.newStatus(status->measuredFloat(1), tree.sensors[1]);
+  ASSERT_EQ(engine.publishChanges(), 2);
+  ASSERT_EQ(lifecycle->inbox.size(), 6);
+  ASSERT_EQ(engine.getGroupHealth(group), StatusLevel::OK);
+
+  // Polled objects are read again, the dummy sensor is still OK
+  engine.markDirty(tree.sensors[0]);
+  ASSERT_EQ(engine.publishChanges(), 1);
+  ASSERT_EQ(lifecycle->inbox.size(), 6);
+}
+
+TEST_F(StatusEngineTest, healthEventsAreDistinct) {
+  constructTree(1, 2);
+  auto health = SubscriberBuilder::empty()
+                    .allSources()
+                    .addEvent(EventType::LIFECYCLE)
+                    .allDataTypes()
+                    .allHashedNames()
+                    .addCustomFieldMask(SHI::StatusEngine::AGGREGATE_HEALTH)
+                    .build();
+  SHI::EventBus::Bus::get()->subscribe(health);
+  auto ownStatus =
+      SubscriberBuilder::everything()
+          .excludeCustomFieldMask(SHI::StatusEngine::AGGREGATE_HEALTH)
+          .build();
+  SHI::EventBus::Bus::get()->subscribe(ownStatus);
+
+  engine.newStatus(status->measuredNoData(), tree.sensors[0]);
+  engine.publishChanges();
+  ASSERT_EQ(health->inbox.size(), 1);
+  ASSERT_EQ(ownStatus->inbox.size(), 1);
+  // The group's own status changes from <NO_DATA> to OK, its health does not
+  engine.newStatus(status->measuredFloat(1), tree.groups[0]);
+  engine.publishChanges();
+  ASSERT_EQ(engine.getTrackedStatus(tree.groups[0]), StatusLevel::OK);
+  ASSERT_EQ(engine.getGroupHealth(tree.groups[0]), StatusLevel::NO_DATA);
+  ASSERT_EQ(health->inbox.size(), 1);
+  ASSERT_EQ(ownStatus->inbox.size(), 2);
+  ASSERT_EQ(lifecycle->inbox.size(), 3);
+}
+
+TEST_F(StatusEngineTest, largeTreeOnlyReadsChanges) {
+  constructTree(20, 10, "Counting");
+  ASSERT_EQ(tree.sensors.size(), 200);
+  std::vector<CountingSensor *> sensors;
+  for (auto sensor : tree.sensors) {
+    sensors.push_back(static_cast<CountingSensor *>(sensor));
+    // Indexing reads every sensor once
+    ASSERT_EQ(sensors.back()->statusReads, 1);
+    sensors.back()->statusReads = 0;
+  }
+  ASSERT_EQ(engine.publishChanges(), 0);
+  engine.newStatus(status->measuredNoData(), tree.sensors[0]);
+  engine.newStatus(status->measuredNoData(), tree.sensors[0]);
+  engine.newStatus(status->measuredNoData(), tree.sensors[105]);
+  engine.markDirty(tree.sensors[199]);
+  ASSERT_EQ(engine.publishChanges(), 3);
+  ASSERT_EQ(lifecycle->inbox.size(), 4);
+  // Pushed statuses are not read back, only the polled sensor is
+  for (size_t i = 0; i < sensors.size(); i++)
+    ASSERT_EQ(sensors[i]->statusReads, i == 199 ? 1 : 0) << i;
+  ASSERT_EQ(engine.getGroupHealth(tree.groups[0]), StatusLevel::NO_DATA);
+  ASSERT_EQ(engine.getGroupHealth(tree.groups[10]), StatusLevel::NO_DATA);
+  ASSERT_EQ(engine.getGroupHealth(tree.groups[19]), StatusLevel::OK);
+  ASSERT_EQ(engine.publishChanges(), 0);
+  ASSERT_EQ(sensors[199]->statusReads, 1);
+}
+
+TEST_F(StatusEngineTest, readingsRepollTheirSensor) {
+  constructTree(1, 2, "Counting");
+  auto first = static_cast<CountingSensor *>(tree.sensors[0]);
+  auto second = static_cast<CountingSensor *>(tree.sensors[1]);
+  first->statusReads = 0;
+  second->statusReads = 0;
+  first->failing = true;
+  engine.newReading(SHI::MeasurementBundle({}, first));
+  ASSERT_EQ(engine.pendingChanges(), 1);
+  ASSERT_EQ(engine.publishChanges(), 1);
+  ASSERT_EQ(first->statusReads, 1);
+  ASSERT_EQ(second->statusReads, 0);
+  ASSERT_EQ(engine.getTrackedStatus(first), StatusLevel::NO_DATA);
+  // The sensor and the group health changed
+  ASSERT_EQ(lifecycle->inbox.size(), 2);
+  engine.newReading(SHI::MeasurementBundle({}, first));
+  ASSERT_EQ(engine.publishChanges(), 1);
+  ASSERT_EQ(lifecycle->inbox.size(), 2);
+}
+
+TEST_F(StatusEngineTest, drivenByHardwareLoop) {
+  auto factory = SHI::Factory::get();
+  ASSERT_EQ(factory->getError(
+                factory->construct(generateTree(2, 1, "Counting", true))),
+            SHI::FactoryErrors::None);
+  ASSERT_NE(registeredEngine, nullptr);
+  SHI::hw->setup("StatusEngineTest");
+  // Hardware, two communicators, two groups and two sensors
+  ASSERT_EQ(registeredEngine->trackedObjects(), 7);
+  SHI::hw->accept(tree);
+  auto sensor = static_cast<CountingSensor *>(tree.sensors[0]);
+  auto sensorEvent = subscribeToStatus("Dummy", StatusLevel::NO_DATA);
+  auto healthEvent = subscribeToStatus("Group0", StatusLevel::NO_DATA,
+                                       SHI::StatusEngine::AGGREGATE_HEALTH);
+
+  // The sensor fails and pushes its status
+  sensor->failing = true;
+  registeredEngine->newStatus(sensor->getStatus(), sensor);
+  SHI::hw->loop();
+  ASSERT_EQ(lifecycle->inbox.size(), 2);
+  ASSERT_EQ(sensorEvent->inbox.size(), 1);
+  ASSERT_EQ(healthEvent->inbox.size(), 1);
+  // Re-polling the still failing sensor publishes nothing new
+  for (int i = 0; i < 12; i++) {
+    SHI::hw->loop();
+    ASSERT_EQ(lifecycle->inbox.size(), 2) << i;
+  }
+  // The recovery is picked up from the readings of the sensor
+  sensor->failing = false;
+  for (int i = 0; i < 12; i++) SHI::hw->loop();
+  ASSERT_EQ(lifecycle->inbox.size(), 4);
+  ASSERT_EQ(registeredEngine->getTrackedStatus(sensor), StatusLevel::OK);
+  ASSERT_EQ(registeredEngine->getGroupHealth(tree.groups[0]), StatusLevel::OK);
+  ASSERT_EQ(sensorEvent->inbox.size(), 1);
+  ASSERT_EQ(healthEvent->inbox.size(), 1);
+}
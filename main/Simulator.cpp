@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#include "Simulator.h"
+
+#include <algorithm>
+#include <utility>
+
+void SHI::Simulator::schedule(int64_t atMs, std::function<void()> action) {
+  events.push(
+      {std::max(atMs, clock->now()), nextSequence++, 0, std::move(action)});
+}
+
+bool SHI::Simulator::every(int64_t periodMs, std::function<void()> action) {
+  if (periodMs <= 0) return false;
+  events.push(
+      {clock->now() + periodMs, nextSequence++, periodMs, std::move(action)});
+  return true;
+}
+
+size_t SHI::Simulator::runUntil(int64_t endMs) {
+  endMs = std::max(endMs, clock->now());
+  size_t executed = 0;
+  while (!events.empty() && events.top().time <= endMs) {
+    Event event = events.top();
+    events.pop();
+    clock->set(event.time);
+    event.action();
+    executed++;
+    if (event.period > 0) {
+      event.time += event.period;
+      event.sequence = nextSequence++;
+      events.push(std::move(event));
+    }
+  }
+  clock->set(endMs);
+  return executed;
+}
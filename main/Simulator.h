@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace SHI {
+
+/**
+ * Virtual time source for the LoggingHardware. Time only moves when it is
+ * advanced, which makes timing behaviour reproducible. Like a real clock it
+ * never moves backwards.
+ */
+class SimulatedClock {
+ public:
+  explicit SimulatedClock(int64_t startMs = 0) : nowMs(startMs) {}
+  int64_t now() const { return nowMs; }
+  void advance(int64_t ms) {
+    if (ms > 0) nowMs += ms;
+  }
+  // Moves the clock forward to ms, earlier times are ignored
+  void set(int64_t ms) {
+    if (ms > nowMs) nowMs = ms;
+  }
+
+ private:
+  int64_t nowMs;
+};
+
+/**
+ * Discrete-event simulator on top of a SimulatedClock. Scheduled actions run
+ * in time order, actions scheduled for the same time run in the order they
+ * were scheduled. Actions scheduled in the past run at the current time.
+ * Running jumps the clock from one event to the next, so hours of sensor
+ * loops take only as long as the actions themselves.
+ */
+class Simulator {
+ public:
+  explicit Simulator(SimulatedClock *clock) : clock(clock) {}
+
+  void schedule(int64_t atMs, std::function<void()> action);
+  void scheduleIn(int64_t delayMs, std::function<void()> action) {
+    schedule(clock->now() + delayMs, std::move(action));
+  }
+  /**
+   * Runs action every periodMs, starting one period from now. A periodMs
+   * that is not positive is rejected and nothing is scheduled, returns
+   * whether the action was scheduled.
+   */
+  bool every(int64_t periodMs, std::function<void()> action);
+
+  /**
+   * Runs all actions up to and including endMs and leaves the clock at endMs.
+   * An endMs in the past runs the actions that are due now. Returns the
+   * number of actions that were run.
+   */
+  size_t runUntil(int64_t endMs);
+  size_t runFor(int64_t durationMs) {
+    return runUntil(clock->now() + durationMs);
+  }
+  size_t pending() const { return events.size(); }
+
+ private:
+  struct Event {
+    int64_t time;
+    uint64_t sequence;
+    // 0 for actions that only run once
+    int64_t period;
+    std::function<void()> action;
+  };
+  struct Later {
+    bool operator()(const Event &a, const Event &b) const {
+      return a.time != b.time ? a.time > b.time : a.sequence > b.sequence;
+    }
+  };
+
+  SimulatedClock *clock;
+  uint64_t nextSequence = 0;
+  std::priority_queue<Event, std::vector<Event>, Later> events;
+};
+
+}  // namespace SHI
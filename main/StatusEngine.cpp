@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#include "StatusEngine.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+const int SHI::StatusEngine::AGGREGATE_HEALTH;
+
+namespace {
+
+const char *const STATUS_NAMES[3]{"OK", "<NO_DATA>", "ERROR"};
+
+}  // namespace
+
+SHI::StatusLevel SHI::StatusEngine::toStatusLevel(const Measurement &status) {
+  // The data state is ordered VALID, NO_DATA, ERROR like StatusLevel
+  return static_cast<StatusLevel>(static_cast<int>(status.getDataState()));
+}
+
+void SHI::StatusEngine::setupCommunication() {
+  nodes.clear();
+  groups.clear();
+  index.clear();
+  dirtyNodes.clear();
+  currentGroup = NO_GROUP;
+  if (SHI::hw != nullptr) SHI::hw->accept(*this);
+}
+
+void SHI::StatusEngine::addNode(SHIObject *object, EventBus::SourceType source,
+                                std::function<Measurement()> readStatus,
+                                bool isGroup) {
+  StatusLevel level = toStatusLevel(readStatus());
+  index[object] = nodes.size();
+  nodes.push_back({object, std::string(object->getName()), source,
+                   std::move(readStatus), level, level, false, false,
+                   currentGroup, isGroup});
+}
+
+void SHI::StatusEngine::enterVisit(Sensor *sensor) {
+  addNode(sensor, EventBus::SourceType::SENSOR,
+          [sensor]() { return sensor->getStatus(); }, false);
+  if (currentGroup == NO_GROUP) return;
+  Group &group = groups[currentGroup];
+  group.sensorCount[static_cast<int>(nodes.back().level)]++;
+  updateGroupHealth(&group, false);
+}
+
+void SHI::StatusEngine::enterVisit(SensorGroup *channel) {
+  currentGroup = groups.size();
+  groups.push_back({nodes.size(), {0, 0, 0}, StatusLevel::OK});
+  addNode(channel, EventBus::SourceType::SENSOR,
+          [channel]() { return channel->getStatus(); }, true);
+}
+
+void SHI::StatusEngine::enterVisit(Hardware *harwdware) {
+  // The hardware is the node the sensors run on, so it is published as such
+  addNode(harwdware, EventBus::SourceType::SENSOR,
+          [harwdware]() { return harwdware->getStatus(); }, false);
+}
+
+void SHI::StatusEngine::visit(Communicator *communicator) {
+  addNode(communicator, EventBus::SourceType::COMMUNICATOR,
+          [communicator]() { return communicator->getStatus(); }, false);
+}
+
+void SHI::StatusEngine::newStatus(const Measurement &status, SHIObject *src) {
+  auto it = index.find(src);
+  if (it == index.end()) return;
+  Node &node = nodes[it->second];
+  node.pendingLevel = toStatusLevel(status);
+  node.hasPending = true;
+  if (!node.dirty) {
+    node.dirty = true;
+    dirtyNodes.push_back(it->second);
+  }
+}
+
+void SHI::StatusEngine::markDirty(SHIObject *src) {
+  auto it = index.find(src);
+  if (it == index.end()) return;
+  Node &node = nodes[it->second];
+  if (!node.dirty) {
+    node.dirty = true;
+    dirtyNodes.push_back(it->second);
+  }
+}
+
+size_t SHI::StatusEngine::publishChanges() {
+  size_t processed = dirtyNodes.size();
+  for (auto nodeIdx : dirtyNodes) {
+    Node &node = nodes[nodeIdx];
+    StatusLevel level =
+        node.hasPending ? node.pendingLevel : toStatusLevel(node.readStatus());
+    node.dirty = false;
+    node.hasPending = false;
+    if (level == node.level) continue;
+    StatusLevel previous = node.level;
+    node.level = level;
+    publish(node.name, node.source, level, 0);
+    if (node.group != NO_GROUP && !node.isGroup) {
+      Group &group = groups[node.group];
+      group.sensorCount[static_cast<int>(previous)]--;
+      group.sensorCount[static_cast<int>(level)]++;
+      updateGroupHealth(&group, true);
+    }
+  }
+  dirtyNodes.clear();
+  return processed;
+}
+
+void SHI::StatusEngine::updateGroupHealth(Group *group, bool notify) {
+  StatusLevel health = StatusLevel::OK;
+  for (int level = 2; level > 0; level--) {
+    if (group->sensorCount[level] > 0) {
+      health = static_cast<StatusLevel>(level);
+      break;
+    }
+  }
+  if (health == group->health) return;
+  group->health = health;
+  if (!notify) return;
+  const Node &node = nodes[group->node];
+  publish(node.name, node.source, health, AGGREGATE_HEALTH);
+}
+
+void SHI::StatusEngine::publish(const std::string &name,
+                                EventBus::SourceType source,
+                                StatusLevel level, int flags) {
+  auto event = EventBus::EventBuilder::source(source)
+                   .event(EventBus::EventType::LIFECYCLE)
+                   .data(EventBus::DataType::STRING)
+                   .customField((1 << static_cast<int>(level)) | flags)
+                   .hash(name.c_str())
+                   .build(std::make_shared<std::string>(
+                       STATUS_NAMES[static_cast<int>(level)]));
+  bus->publish(event);
+}
+
+SHI::StatusLevel SHI::StatusEngine::getTrackedStatus(
+    SHIObject *src) const {
+  auto it = index.find(src);
+  if (it == index.end()) return StatusLevel::NO_DATA;
+  return nodes[it->second].level;
+}
+
+SHI::StatusLevel SHI::StatusEngine::getGroupHealth(SensorGroup *group) const {
+  auto it = index.find(group);
+  if (it == index.end()) return StatusLevel::NO_DATA;
+  const Node &node = nodes[it->second];
+  if (node.group == NO_GROUP) return StatusLevel::NO_DATA;
+  return groups[node.group].health;
+}
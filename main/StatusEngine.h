@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SHICommunicator.h"
+#include "SHIEventBus.h"
+#include "SHIHardware.h"
+#include "SHISensor.h"
+#include "SHIVisitor.h"
+
+namespace SHI {
+
+enum class StatusLevel { OK = 0, NO_DATA = 1, ERROR = 2 };
+
+/**
+ * Incremental status tracking for a constructed tree.
+ *
+ * The engine is a Communicator, so it can be registered in $comms. On setup
+ * it indexes every object of the tree once by visiting it. Afterwards
+ * objects are only looked at when they are marked dirty: by a pushed status
+ * via newStatus(), by a reading they produced via newReading(), which
+ * re-polls the status of the sensor, or by markDirty() for anything else.
+ * Objects that neither push a status nor produce readings are only read on
+ * setup. publishChanges(), which also runs on every loopCommunication(),
+ * processes the dirty objects and publishes every status transition as
+ * EventType::LIFECYCLE event. The custom field of such an event has the bit
+ * of the new StatusLevel set.
+ *
+ * The aggregated health of each SensorGroup is the worst status of its
+ * sensors and is kept up to date on each transition. Health transitions are
+ * published with the AGGREGATE_HEALTH bit set in the custom field, which
+ * tells them apart from transitions of the group's own status.
+ */
+class StatusEngine : public Communicator, public Visitor {
+ public:
+  static const int AGGREGATE_HEALTH = 1 << 3;
+
+  explicit StatusEngine(EventBus::Bus *bus = EventBus::Bus::get())
+      : Communicator("StatusEngine"), bus(bus) {}
+
+  void setupCommunication() override;
+  void loopCommunication() override { publishChanges(); }
+  void newReading(const MeasurementBundle &reading) override {
+    markDirty(reading.src);
+  }
+  void newStatus(const Measurement &status, SHIObject *src) override;
+  const Configuration *getConfig() const override { return nullptr; }
+  bool reconfigure(Configuration *newConfig) override { return true; }
+
+  void enterVisit(Sensor *sensor) override;
+  void leaveVisit(Sensor *sensor) override {}
+  void enterVisit(SensorGroup *channel) override;
+  void leaveVisit(SensorGroup *channel) override { currentGroup = NO_GROUP; }
+  void enterVisit(Hardware *harwdware) override;
+  void leaveVisit(Hardware *harwdware) override {}
+  void visit(Communicator *communicator) override;
+  void visit(MeasurementMetaData *data) override {}
+
+  void markDirty(SHIObject *src);
+  /**
+   * Publishes the transitions of all dirty objects and returns how many
+   * objects were processed.
+   */
+  size_t publishChanges();
+
+  StatusLevel getTrackedStatus(SHIObject *src) const;
+  StatusLevel getGroupHealth(SensorGroup *group) const;
+  size_t trackedObjects() const { return nodes.size(); }
+  size_t pendingChanges() const { return dirtyNodes.size(); }
+
+  static StatusLevel toStatusLevel(const Measurement &status);
+
+ private:
+  static const size_t NO_GROUP = static_cast<size_t>(-1);
+
+  struct Node {
+    SHIObject *object;
+    std::string name;
+    EventBus::SourceType source;
+    std::function<Measurement()> readStatus;
+    StatusLevel level;
+    StatusLevel pendingLevel;
+    bool hasPending;
+    bool dirty;
+    // Index into groups, for sensors and the group node itself
+    size_t group;
+    bool isGroup;
+  };
+  struct Group {
+    size_t node;
+    std::array<int, 3> sensorCount;
+    StatusLevel health;
+  };
+
+  void addNode(SHIObject *object, EventBus::SourceType source,
+               std::function<Measurement()> readStatus, bool isGroup);
+  void publish(const std::string &name, EventBus::SourceType source,
+               StatusLevel level, int flags);
+  void updateGroupHealth(Group *group, bool notify);
+
+  EventBus::Bus *bus;
+  std::vector<Node> nodes;
+  std::vector<Group> groups;
+  std::unordered_map<SHIObject *, size_t> index;
+  std::vector<size_t> dirtyNodes;
+  size_t currentGroup = NO_GROUP;
+};
+
+}  // namespace SHI
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2020 Karsten Becker All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the LICENSE file.
+ */
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "DummySensor.h"
+#include "LoggingComms.h"
+#include "LoggingHW.h"
+#include "SHIFactory.h"
+#include "Simulator.h"
+
+/**
+ * Registers the factories for the objects used in json/in/construct.json.
+ * A quiet hardware discards its log output, with a clock it runs on
+ * simulated time. Returns false if any of the factories could not be
+ * registered.
+ */
+inline bool registerTestFactories(bool quiet = false,
+                                  SHI::SimulatedClock *clock = nullptr) {
+  auto factory = SHI::Factory::get();
+  if (factory == nullptr) return false;
+  bool registered = factory->registerFactory("hw", [=](JsonObject obj) {
+    auto resObj = new SHI::LoggingHardware();
+    if (quiet) resObj->setLogStream(nullptr);
+    if (clock != nullptr) resObj->setClock(clock);
+    return factory->defaultHardwareFactory(resObj, obj);
+  });
+  registered &=
+      factory->registerFactory("LoggingCommunicator", [=](JsonObject obj) {
+        return factory->objToResult(new LoggingCommunicator());
+      });
+  registered &= factory->registerFactory("sensorGroup", [=](JsonObject obj) {
+    return factory->defaultSensorGroupFactory(obj);
+  });
+  registered &= factory->registerFactory("Dummy", [=](JsonObject obj) {
+    return factory->objToResult(new DummySensor());
+  });
+  return registered;
+}
+
+/**
+ * Returns the content of fileName, or an empty string if it can't be read.
+ */
+inline std::string loadFile(const char *fileName) {
+  std::ifstream inFile(fileName);
+  std::stringstream strStream;
+  strStream << inFile.rdbuf();
+  return strStream.str();
+}
+
+/**
+ * Returns a path for fileName in the temporary directory of the test, so
+ * nothing is written into the source tree.
+ */
+inline std::string tempFile(const char *fileName) {
+  const char *dir = std::getenv("TEST_TMPDIR");
+  if (dir == nullptr) dir = std::getenv("TMPDIR");
+  if (dir == nullptr) dir = "/tmp";
+  return std::string(dir) + "/" + fileName;
+}
@@ -0,0 +1,29 @@
+#!/bin/bash
+# Copyright (c) 2020 Karsten Becker All rights reserved.
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file.
+#
+# Usage: runBenchmarks.sh <benchmark> <CompareBenchmarks> [baseline.json]
+#
+# Runs the benchmark binary briefly and writes its JSON output. Fails when
+# the binary fails or a benchmark reported an error. With a baseline the
+# results are also compared against it and a regression fails.
+set -eu
+
+benchmark="$1"
+compare="$2"
+baseline="${3:-}"
+out="${TEST_TMPDIR:-/tmp}/$(basename "$benchmark").json"
+
+if [ -z "$baseline" ]; then
+  "$benchmark" --benchmark_min_time=0.01 --benchmark_out="$out" \
+      --benchmark_out_format=json
+  # Comparing the results with themselves only fails on errored runs
+  "$compare" "$out" "$out"
+else
+  # The same settings the baseline is recorded with, see baseline/README.md
+  "$benchmark" --benchmark_repetitions=5 \
+      --benchmark_report_aggregates_only=true --benchmark_out="$out" \
+      --benchmark_out_format=json
+  "$compare" "$baseline" "$out" --threshold="${BENCHMARK_THRESHOLD:-0.1}"
+fi